@@ -3,8 +3,8 @@
   Project: ESP32 based WiFi/MQTT enabled (2) Double Searchlight High Absolute, (4) Single Searchlight High Absolute, and (1) Double Head Dwarf signal Neopixel Node
   (7 signal mast outputs / 10 Neopixel Signal Heads)
   Author: Thomas Seitz (thomas.seitz@tmrci.org)
-  Version: 1.0.3
-  Date: 2023-08-01
+  Version: 1.0.4
+  Date: 2026-10-18
   Description: This sketch is designed for an OTA-enabled ESP32 Node with 7 signal mast outputs, using MQTT to subscribe to messages published by JMRI.
   The expected incoming subscribed messages are for JMRI Signal Mast objects, and the expected message payload format is 'Aspect; Lit (or Unlit); Unheld (or Held)'.
   NodeID and IP address displayed on attached 128×64 OLED display. NodeID is also the ESP32 host name for easy network identification.
@@ -67,9 +67,21 @@ String aspectStr = "";
 
 unsigned long ipDisplayStartTime = 0;
 
+// Boot pipeline state: WiFi and MQTT connect in the background while the masts are brought up
+const unsigned long WIFI_RETRY_INTERVAL = 10000;             // Milliseconds without WiFi before the association is restarted
+const unsigned long MQTT_RETRY_INTERVAL = 5000;              // Milliseconds between MQTT connection attempts
+const int32_t MQTT_CONNECT_TIMEOUT = 1000;                   // Milliseconds allowed for the TCP connection to the broker
+const uint16_t MQTT_SOCKET_TIMEOUT = 2;                      // Seconds to wait for the broker to answer CONNECT
+unsigned long lastWiFiAttempt = 0;                            // Time of the last WiFi.begin() or of the last lost connection
+unsigned long lastMQTTAttempt = 0;                            // Time of the last MQTT connection attempt
+bool wifiConnected = false;                                   // True once the current WiFi connection has been reported
+bool otaStarted = false;                                      // True once the OTA service has been started
+bool nodeOperational = false;                                 // True once the node has first connected to MQTT
+
 // Function Prototypes
 void callback(char* topic, byte* payload, unsigned int length);
 void reconnectMQTT();
+void logBootStage(const char* stage);
 void updateDisplay(const String& aspectStr);
 
 // Define the signal aspects and lookup tables
@@ -119,6 +131,14 @@ const std::map<std::string, Aspect> doubleHeadDwarfSignalLookup = {
     {"null", {RED, RED}}
 };
 
+// Print a timestamped boot stage to track time-to-operational
+void logBootStage(const char* stage) {
+    Serial.print("[");
+    Serial.print(millis());
+    Serial.print(" ms] Boot stage: ");
+    Serial.println(stage);
+}
+
 void setupHostname() {
     WiFi.setHostname(NodeID.c_str());
 }
@@ -129,20 +149,32 @@ void setup() {
   delay(10);
   Serial.println("Setup started");
 
-  // Initialize WiFi and connect to the network
+    // Initialize each Neopixel signal mast with a stop signal or turn off based on mast type
+    for (int i = 0; i < 7; i++) {
+        signalMasts[i].begin();
+        signalMasts[i].setBrightness(255); // Set brightness
+    
+        if (i < 2) { 
+            // For masts 1-2 (double head absolute signal masts)
+            signalMasts[i].setPixelColor(0, RED); // Set first head as RED
+            signalMasts[i].setPixelColor(1, RED); // Set second head as RED
+        } else if (i < 6) { 
+            // For masts 3-6 (single head absolute signal masts)
+            signalMasts[i].setPixelColor(0, RED); // Set head as RED
+        } else { 
+            // For mast 7 (double head dwarf signal mast)
+            signalMasts[i].setPixelColor(0, RED); // Set first head as RED
+            signalMasts[i].setPixelColor(1, RED); // Set second head as RED
+        }
+        signalMasts[i].show(); // Display the set colors
+    }
+    logBootStage("Signal masts set to Stop");
+
+  // Start WiFi association in the background; it completes while the rest of setup runs
+  setupHostname(); // Set the hostname before the association starts
   WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
-  while (WiFi.status() != WL_CONNECTED) {
-    delay(500);
-    Serial.println("Connecting to WiFi...");
-  }
-  setupHostname(); // Set the hostname before connecting to MQTT
-
-  // Display the hostname
-  Serial.print("Hostname: ");
-  Serial.println(WiFi.getHostname());
-  
-  Serial.println("Connected to WiFi");
-  Serial.println("IP address: " + WiFi.localIP().toString()); // Display IP address
+  lastWiFiAttempt = millis();
+  logBootStage("WiFi association started");
 
   // Initialize OTA
   ArduinoOTA.onStart([]() {
@@ -174,36 +206,13 @@ void setup() {
   // Set password for OTA updates
   ArduinoOTA.setPassword("TMRCI");
 
-  // Start OTA service
-  ArduinoOTA.begin();
-  Serial.println("OTA Initialized. Waiting for OTA updates...");
+  // OTA service is started by reconnectMQTT() once WiFi connects
 
-  // Connect to the MQTT broker
+  // Configure the MQTT broker; the connection is made from loop() once WiFi is up
   client.setServer(MQTT_SERVER, MQTT_PORT);
+  client.setSocketTimeout(MQTT_SOCKET_TIMEOUT);
   client.setCallback(callback);
-  reconnectMQTT();
-  Serial.println("Connected to MQTT");
 
-    // Initialize each Neopixel signal mast with a stop signal or turn off based on mast type
-    for (int i = 0; i < 7; i++) {
-        signalMasts[i].begin();
-        signalMasts[i].setBrightness(255); // Set brightness
-    
-        if (i < 2) { 
-            // For masts 1-2 (double head absolute signal masts)
-            signalMasts[i].setPixelColor(0, RED); // Set first head as RED
-            signalMasts[i].setPixelColor(1, RED); // Set second head as RED
-        } else if (i < 6) { 
-            // For masts 3-6 (single head absolute signal masts)
-            signalMasts[i].setPixelColor(0, RED); // Set head as RED
-        } else { 
-            // For mast 7 (double head dwarf signal mast)
-            signalMasts[i].setPixelColor(0, RED); // Set first head as RED
-            signalMasts[i].setPixelColor(1, RED); // Set second head as RED
-        }
-        signalMasts[i].show(); // Display the set colors
-    }
-    
     if (!display.begin(SSD1306_SWITCHCAPVCC, 0x3C)) { // Address 0x3C for 128x64
         Serial.println(F("SSD1306 allocation failed"));
         for (;;); 
@@ -212,6 +221,7 @@ void setup() {
 
     // Update display if NodeID or IP address changed
     updateDisplay(aspectStr);
+    logBootStage("Local hardware ready");
 }
 
 void loop() {
@@ -227,26 +237,69 @@ void loop() {
 }
 
 void reconnectMQTT() {
-    // Attempt to reconnect to both WiFi and MQTT
-    while (!client.connected()) {
-        Serial.println("Attempting to connect to WiFi...");
-        WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
-        while (WiFi.status() != WL_CONNECTED) {
-            delay(500);
-            Serial.println("Connecting to WiFi...");
+    // WiFi associates in the background, so never block waiting for it
+    if (WiFi.status() != WL_CONNECTED) {
+        if (wifiConnected) {
+            // Connection lost: give the core's auto-reconnect the first chance
+            wifiConnected = false;
+            lastWiFiAttempt = millis();
         }
-        setupHostname(); // Set the hostname before connecting to MQTT
 
+        // The core does not retry after every disconnect reason (e.g. AUTH_FAIL while the AP is still booting),
+        // so restart the association if WiFi has not come back within WIFI_RETRY_INTERVAL
+        if (millis() - lastWiFiAttempt >= WIFI_RETRY_INTERVAL) {
+            Serial.println("WiFi not connected. Restarting WiFi association...");
+            WiFi.disconnect();
+            setupHostname(); // Set the hostname before the association starts
+            WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+            lastWiFiAttempt = millis();
+        }
+        return;
+    }
+
+    if (!wifiConnected) {
+        wifiConnected = true;
         Serial.println("Connected to WiFi");
+        Serial.println("IP address: " + WiFi.localIP().toString()); // Display IP address
+        Serial.print("Hostname: ");
+        Serial.println(WiFi.getHostname());
+        logBootStage("WiFi connected");
+
+        // Start OTA service the first time the network is up
+        if (!otaStarted) {
+            ArduinoOTA.begin();
+            otaStarted = true;
+            Serial.println("OTA Initialized. Waiting for OTA updates...");
+        }
+
+        updateDisplay(aspectStr); // Show the new IP address
+    }
+
+    // Space out MQTT connection attempts instead of delaying the loop. The interval is
+    // measured from the end of the last attempt, which is bounded by the TCP connect
+    // timeout and the socket timeout.
+    if (lastMQTTAttempt != 0 && millis() - lastMQTTAttempt < MQTT_RETRY_INTERVAL) {
+        return;
+    }
 
-        Serial.println("Attempting to connect to MQTT...");
-        if (client.connect(NodeID.c_str())) {
-            client.subscribe((mqttTopic + "+").c_str()); // Subscribe to topics for all signal masts
-            Serial.println("Connected to MQTT");
-        } else {
-            Serial.println("MQTT connection failed. Retrying in 5 seconds...");
-            delay(5000);
+    Serial.println("Attempting to connect to MQTT...");
+    bool mqttConnected = espClient.connect(MQTT_SERVER, MQTT_PORT, MQTT_CONNECT_TIMEOUT) &&
+                         client.connect(NodeID.c_str());
+    lastMQTTAttempt = millis();
+
+    if (mqttConnected) {
+        client.subscribe((mqttTopic + "+").c_str()); // Subscribe to topics for all signal masts
+        Serial.println("Connected to MQTT");
+        logBootStage("MQTT connected");
+
+        if (!nodeOperational) {
+            nodeOperational = true;
+            logBootStage("Node operational");
         }
+    } else {
+        Serial.print("MQTT connection failed. Retrying in ");
+        Serial.print(MQTT_RETRY_INTERVAL / 1000);
+        Serial.println(" seconds...");
     }
 }
 
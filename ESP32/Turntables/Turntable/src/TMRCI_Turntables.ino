@@ -1,10 +1,10 @@
 // Define the version number.
-const char * VERSION_NUMBER = "1.1.48";
+const char * VERSION_NUMBER = "1.1.49";
 
 /* Aisle-Node: Turntable Control
    Project: ESP32-based WiFi/MQTT Turntable Node
    Author: Thomas Seitz (thomas.seitz@tmrci.org)
-   Date: 2023-07-16
+   Date: 2026-10-18
    Description:
    This sketch is designed for an OTA-enabled ESP32 Node controlling a Turntable. It utilizes various components, including a DIYables 3x4 membrane matrix keypad,
    a GeeekPi IIC I2C TWI Serial LCD 2004 20x4 Display Module with I2C Interface, KRIDA Electronics Relay Modules, a STEPPERONLINE Stepper Drive, a TT Electronics Photologic 
@@ -95,6 +95,14 @@ void printToLCD(int row,
   }
 }
 
+// Helper function to print a timestamped boot stage to the serial monitor. This is used to track the time-to-operational of the node.
+void logBootStage(const char * stage) {
+  Serial.print("[");
+  Serial.print(millis());
+  Serial.print(" ms] Boot stage: ");
+  Serial.println(stage);
+}
+
 // Helper function to clear the LCD display. If the LCD is not available, this function does nothing.
 void clearLCD() {
   lcd.clear();
@@ -115,10 +123,12 @@ void initializeLCD() {
   #endif
 }
 
-// Function to initialize the relay boards. This function initializes two relay boards.
+// Function to initialize the relay boards. This function initializes two relay boards and turns off all track power relays.
 void initializeRelayBoards() {
   relayBoard1.begin(); // Initialize the first relay board.
   relayBoard2.begin(); // Initialize the second relay board.
+
+  turnOffAllRelays(); // No track is powered until the turntable has been homed
 }
 
 // Function to initialize the stepper motor. This function sets the maximum speed and acceleration for the stepper motor.
@@ -210,20 +220,22 @@ void initializePeripherals() {
   EEPROM.begin(EEPROM_TOTAL_SIZE_BYTES); // Initialize EEPROM.
 }
 
-// Function to connect to the WiFi network and MQTT broker. This function connects to the WiFi network and the MQTT broker, and subscribes to the MQTT topic.
-void connectToNetwork() {
-  connectToWiFi(); // Connect to the WiFi network.
-  connectToMQTT(); // Connect to the MQTT broker and subscribe to the topic.
+// Function to start the network connection. This function starts the WiFi association and returns immediately; the MQTT broker is connected from the main loop.
+void startNetwork() {
+  beginWiFi(); // Start connecting to the WiFi network in the background.
+  logBootStage("WiFi association started");
 }
 
-// Function to initialize various components. This function initializes the LCD display, relay boards, stepper motor, keypad, and LCD, enables OTA updates for the ESP32, and performs the homing sequence.
+// Function to initialize various components. This function initializes the LCD display, relay boards, stepper motor, keypad, and LCD, and performs the homing sequence.
+// OTA updates are enabled from the main loop once WiFi is connected.
 void initializeComponents() {
   initializeLCD(); // Initialize the LCD display.
-  initializeRelayBoards(); // Initialize the relay boards.
+  initializeRelayBoards(); // Initialize the relay boards with all track power off.
+  logBootStage("Relays in safe state");
   initializeStepper(); // Initialize the stepper motor.
   initializeKeypadAndLCD(); // Initialize the keypad and LCD.
-  enableOTAUpdates(); // Enable OTA updates for the ESP32.
   performHomingSequence(); // Perform the homing sequence to calibrate the turntable.
+  logBootStage("Homing complete");
   
   #ifndef CALIBRATION_MODE
   state = WAITING_FOR_INITIAL_KEY; // Initialize the state machine only in operation mode.
@@ -238,14 +250,17 @@ void readEEPROMData() {
   }
 }
 
-// ESP32 setup function to initialize the system. This function initializes peripherals, connects to the network, initializes components, and reads EEPROM data.
+// ESP32 setup function to initialize the system. This function initializes peripherals, starts the network connection, initializes components, and reads EEPROM data.
+// The WiFi association runs in the background while the hardware is initialized and homed.
 void setup() {
   initializePeripherals();
+  logBootStage("Peripherals initialized");
   #ifdef CALIBRATION_MODE
   Serial.println("The sketch is in calibration mode.");
   #endif
-  connectToNetwork();
+  startNetwork();
   initializeComponents();
+  logBootStage("Local hardware ready");
 }
 
 // Function to handle the emergency stop functionality. This function stops the stepper motor and displays a message on the LCD if the emergency stop flag is set.
@@ -388,14 +403,23 @@ void handleKeypadInput() {
   }
 }
 
-// Function to handle WiFi and MQTT connections and message handling. This function reconnects to the WiFi network and MQTT broker if disconnected, and handles MQTT messages and OTA updates.
+// Function to handle WiFi and MQTT connections and message handling. This function reconnects to the MQTT broker if disconnected without blocking, and handles MQTT messages and OTA updates.
 void handleWiFiAndMQTT() {
-  if (WiFi.status() != WL_CONNECTED) {
-    connectToWiFi();
+  static bool otaEnabled = false; // Track if OTA updates have been enabled.
+  static bool nodeOperational = false; // Track if the node has reached the operational stage.
+
+  if (!maintainWiFi()) {
+    return; // WiFi is still connecting in the background.
+  }
+
+  if (!otaEnabled) {
+    enableOTAUpdates(); // Enable OTA updates for the ESP32 once the network is up.
+    otaEnabled = true;
   }
 
-  if (!client.connected()) {
-    connectToMQTT();
+  if (maintainMQTT() && !nodeOperational) {
+    nodeOperational = true;
+    logBootStage("Node operational");
   }
 
   client.loop();
@@ -110,9 +110,21 @@ int calculateTargetPosition(int trackNumber, int endNumber) {
   return targetPosition;
 }
 
+/* Function to turn off all the track power relays.
+   The relays are active LOW, so writing HIGH to every channel of both boards removes power from all tracks.
+   A for loop is used because it allows for iterating through all the relays without having to write separate code for each one. */
+void turnOffAllRelays() {
+  for (uint8_t i = 0; i < 16; i++) {
+    relayBoard1.digitalWrite(i, HIGH);
+  }
+
+  for (uint8_t i = 0; i < 8; i++) {
+    relayBoard2.digitalWrite(i, HIGH);
+  }
+}
+
 /* Function to control track power relays.
-   This function is used to control the relays separately for better code organization and readability.
-   A for loop is used to turn off all the relays because it allows for iterating through all the relays without having to write separate code for each one. */
+   This function is used to control the relays separately for better code organization and readability. */
 void controlRelays(int trackNumber) {
   // Check if the relay for the selected track is already on
   if ((trackNumber >= 1 && trackNumber <= 15 && relayBoard1.digitalRead(trackNumber) == LOW) ||
@@ -120,14 +132,7 @@ void controlRelays(int trackNumber) {
     return; // If the relay for the selected track is already on, no need to change the state of any relay.
   }
 
-  // Turn off all relays
-  for (uint8_t i = 0; i < 16; i++) {
-    relayBoard1.digitalWrite(i, HIGH);
-  }
-
-  for (uint8_t i = 0; i < 8; i++) {
-    relayBoard2.digitalWrite(i, HIGH);
-  }
+  turnOffAllRelays(); // Turn off all relays
 
   // Turn on the relay corresponding to the selected track
   if (trackNumber >= 1 && trackNumber <= 15) {
@@ -90,6 +90,7 @@ extern int trackTails[23];                  // Array to store the tail positions
 
 /* Function prototypes */
 int calculateTargetPosition(int trackNumber, int endNumber);   // Calculates the target position based on the track number and end number.
+void turnOffAllRelays();                                       // Turns off all the track power relays.
 void controlRelays(int trackNumber);                           // Controls the relays to switch the track power to the specified track number.
 void moveToTargetPosition(int targetPosition);                 // Moves the turntable to the target position using the stepper motor.
 void printCurrentPositionRelativeToHome();                     // Prints the current position of the turntable relative to the "home" position. 
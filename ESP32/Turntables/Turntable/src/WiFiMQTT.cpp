@@ -9,25 +9,53 @@ const int mqtt_port = 1883;                       // Port number for the MQTT br
 WiFiClient espClient;                             // WiFiClient object used as the network client for the MQTT connection.
 PubSubClient client(espClient);                   // PubSubClient object used for MQTT communication.
 
-/* Function to connect to WiFi. This function uses a while loop to wait for the connection to be established.
-   If the connection fails, the function will retry the connection. This is important to ensure that the ESP32 can always connect to the WiFi network,
-   even if the first attempt fails (for example, due to network issues or the router being temporarily unavailable). */
-void connectToWiFi() {
+/* File-local connection timing */
+static const unsigned long MQTT_RETRY_INTERVAL = 2000;  // Minimum time in milliseconds between MQTT connection attempts.
+static const int32_t MQTT_CONNECT_TIMEOUT = 1000;      // Time in milliseconds to wait for the TCP connection to the broker.
+static const uint16_t MQTT_SOCKET_TIMEOUT = 2;          // Time in seconds PubSubClient waits for the broker to answer a connection attempt (library default is 15).
+static const unsigned long WIFI_RETRY_INTERVAL = 10000; // Time in milliseconds without WiFi before the association is restarted.
+static unsigned long lastWiFiAttemptTime = 0;           // Time of the last WiFi.begin() or of the last lost connection.
+
+/* Function to start the WiFi connection. This function only starts the association and returns immediately.
+   The ESP32 WiFi stack completes the association in the background (maintainWiFi() restarts it if it stalls), so the relay boards,
+   stepper and homing sequence can be brought up while the network is still joining. */
+void beginWiFi() {
+  // Set the hostname based on the location-specific file before the association starts
+  WiFi.setHostname(HOSTNAME);
+
   // Begin WiFi connection with the given ssid and password
   WiFi.begin(ssid, password);
+  lastWiFiAttemptTime = millis();
+}
 
-  // Set the hostname based on the location-specific file
-  WiFi.setHostname(HOSTNAME);
+/* Function to check the WiFi connection. This function never waits for the connection to be established.
+   The ESP32 core does not retry after every disconnect reason (for example AUTH_FAIL while the access point is still booting),
+   so the association is restarted if WiFi has not been connected for WIFI_RETRY_INTERVAL milliseconds.
+   The IP address is printed to the serial monitor and the LCD display each time the connection is (re)established. */
+bool maintainWiFi() {
+  static bool wasConnected = false;
+
+  if (WiFi.status() != WL_CONNECTED) {
+    if (wasConnected) {
+      // Connection lost: give the core's auto-reconnect the first chance
+      wasConnected = false;
+      lastWiFiAttemptTime = millis();
+    }
 
-  // Wait until WiFi connection is established
-  while (WiFi.status() != WL_CONNECTED) {
-    delay(500);
-    Serial.println("Connecting to WiFi...");
+    // Restart the association if WiFi has not come back within the retry interval
+    if (millis() - lastWiFiAttemptTime >= WIFI_RETRY_INTERVAL) {
+      Serial.println("WiFi not connected. Restarting WiFi association...");
+      WiFi.disconnect();
+      beginWiFi();
+    }
+    return false;
   }
 
-  // If WiFi connection is successful, print the IP address to the serial monitor and the LCD display
-  if (WiFi.status() == WL_CONNECTED) {
+  // If WiFi connection was just established, print the IP address to the serial monitor and the LCD display
+  if (!wasConnected) {
+    wasConnected = true;
     Serial.println("Connected to WiFi");
+    logBootStage("WiFi connected");
 
     // Get the IP address and convert it to a string
     IPAddress ipAddress = WiFi.localIP();
@@ -40,45 +68,52 @@ void connectToWiFi() {
     // Print the IP address to the LCD display
     printToLCD(0, "IP Address:");
     printToLCD(1, ipAddressString.c_str());
-  } else {
-    // If WiFi connection failed, print an error message and wait 5 seconds before retrying
-    Serial.println("Failed to connect to WiFi");
-    delay(5000);
   }
+
+  return true;
 }
 
-/* Function to connect to MQTT. This function uses a while loop to wait for the connection to be established.
-   If the connection fails, the function will retry the connection. This is important to ensure that the ESP32 can always connect to the MQTT broker,
-   even if the first attempt fails (for example, due to network issues or the broker being temporarily unavailable). */
-void connectToMQTT() {
-  client.setServer(mqtt_broker, mqtt_port); // Connect to MQTT broker.
+/* Function to connect to MQTT. This function makes a single connection attempt and then waits MQTT_RETRY_INTERVAL milliseconds
+   after that attempt has finished before trying again, instead of looping until the broker answers.
+   The TCP connection is opened with a MQTT_CONNECT_TIMEOUT millisecond limit (PubSubClient reuses an already connected client),
+   and PubSubClient waits at most MQTT_SOCKET_TIMEOUT seconds for the broker to answer. A DNS lookup of a broker hostname comes
+   on top of that. Keypad input, the reset button, the stepper and OTA are paused only for that bounded attempt and then run
+   for a full retry interval. */
+bool maintainMQTT() {
+  static unsigned long lastAttemptTime = 0;
 
-  // Loop until MQTT connection is established
-  while (!client.connected()) {
-    // Check if WiFi connection is lost and reconnect if necessary
-    if (WiFi.status() != WL_CONNECTED) {
-      connectToWiFi();
-    }
+  if (client.connected()) {
+    return true;
+  }
 
-    // Attempt to connect to the MQTT broker with address and port
-    if (client.connect("ESP32Client")) { // ESP32Client is the Client ID.
-      Serial.println("Connected to MQTT");
-      client.setCallback(callback); // Set the callback function.
-      client.subscribe(MQTT_TOPIC); // Subscribe to the MQTT topic.
-    } else {
-      // If MQTT connection failed, print an error message and retry after a delay
-      Serial.print("Failed to connect to MQTT. Retrying in 2 seconds... ");
-      delay(2000);
-    }
+  // Wait for the retry interval to elapse after the end of the last attempt
+  if (lastAttemptTime != 0 && millis() - lastAttemptTime < MQTT_RETRY_INTERVAL) {
+    return false;
   }
 
-  // Check MQTT connection status and print success/failure message
-  if (client.connected()) {
+  client.setServer(mqtt_broker, mqtt_port); // Connect to MQTT broker.
+  client.setSocketTimeout(MQTT_SOCKET_TIMEOUT); // Keep each attempt short when the broker does not answer.
+
+  // Open the TCP connection with a bounded timeout, then attempt to connect to the MQTT broker over it
+  bool mqttConnected = espClient.connect(mqtt_broker, mqtt_port, MQTT_CONNECT_TIMEOUT) &&
+                       client.connect("ESP32Client"); // ESP32Client is the Client ID.
+
+  // Count the retry interval from the end of the attempt so every attempt is followed by a full idle gap
+  lastAttemptTime = millis();
+
+  if (mqttConnected) {
     Serial.println("Connected to MQTT");
-  } else {
-    Serial.println("Failed to connect to MQTT");
-    delay(5000);
+    logBootStage("MQTT connected");
+    client.setCallback(callback); // Set the callback function.
+    client.subscribe(MQTT_TOPIC); // Subscribe to the MQTT topic.
+    return true;
   }
+
+  // If MQTT connection failed, print an error message; the next attempt is made from the main loop
+  Serial.print("Failed to connect to MQTT. Retrying in ");
+  Serial.print(MQTT_RETRY_INTERVAL / 1000);
+  Serial.println(" seconds... ");
+  return false;
 }
 
 /* MQTT callback function to handle incoming messages.
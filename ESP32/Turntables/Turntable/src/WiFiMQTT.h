@@ -24,10 +24,12 @@ extern PubSubClient client;        // PubSubClient object used for MQTT communic
 extern const char* MQTT_TOPIC;     // MQTT topic that the ESP32 will subscribe to for receiving commands.
 
 /* Function prototypes */
-void connectToWiFi();              // Function to connect the ESP32 to the WiFi network. This function will attempt to connect to the WiFi network using the provided SSID and password.
-void connectToMQTT();              // Function to connect the ESP32 to the MQTT broker. This function will attempt to connect to the MQTT broker using the provided address and port.
+void beginWiFi();                  // Function to start connecting the ESP32 to the WiFi network. The association completes in the background while the hardware is initialized.
+bool maintainWiFi();               // Function to check the WiFi connection without blocking. Returns true once the ESP32 is connected to the WiFi network.
+bool maintainMQTT();               // Function to connect the ESP32 to the MQTT broker without blocking. Returns true once the ESP32 is connected to the MQTT broker.
 void callback(char* topic, byte* payload, unsigned int length); // Callback function that is called when an MQTT message is received. This function handles the incoming MQTT messages.
 extern void printToLCD(int row, const char* message);  // Helper function to print a message to a specific row on the LCD display. This function clears the specified row before printing the message.
 extern void clearLCD();            // Helper function to clear the LCD.
+extern void logBootStage(const char* stage); // Helper function to print a timestamped boot stage to the serial monitor.
 
 #endif // WIFIMQTT_H
\ No newline at end of file
@@ -1,8 +1,8 @@
 /*
   Project: Arduino-Nano RP2040 based WiFi CMRI/MQTT enabled SUSIC Input-ONLY Node (72 inputs)
   Author: Thomas Seitz (thomas.seitz@tmrci.org)
-  Version: 1.1.0
-  Date: 2023-05-26
+  Version: 1.1.1
+  Date: 2026-10-18
   Description: A sketch for an Arduino-Nano RP2040 based CMRI SUSIC Input-ONLY Node (72 inputs)
   using MQTT to publish messages subscribed to by JMRI. Message payload is either ACTIVE or INACTIVE.
 */
@@ -37,6 +37,18 @@ const char* NodeID = "10-A-Node-2"; // ***CHANGE TO APPROPRIATE UNIQUE ID***
 const int minSensorId = 1;
 const int maxSensorId = 72;
 
+// Token bucket pacing MQTT publishes so a full snapshot does not overrun the
+// PubSubClient buffer or the WiFi TX queue
+const int PUBLISH_BUCKET_CAPACITY = 8;           // Maximum back-to-back publishes
+const unsigned long PUBLISH_TOKEN_INTERVAL = 5;  // Milliseconds to earn one publish token
+int publishTokens = PUBLISH_BUCKET_CAPACITY;
+unsigned long lastTokenRefill = 0;
+
+// Retained full-state snapshot published whenever MQTT (re)connects
+bool snapshotPending = false;             // True while the snapshot is in progress
+int snapshotNextIndex = 0;                // Next sensor (array index) to publish
+unsigned long snapshotStartMillis = 0;    // Time the snapshot was started
+
 void setup() {
   // Initialize the latch pin for the shift registers as output
   pinMode(LATCH_165, OUTPUT);
@@ -87,19 +99,28 @@ void loop() {
   }
 
   // Publish input state changes over MQTT
+  refillPublishTokens();
   for (int i = minSensorId; i <= maxSensorId; i++) {
     int arrayIndex = i - minSensorId;
     int byteIndex = arrayIndex / 8;
     int bitIndex = arrayIndex % 8;
-    if (bitRead(currentInputState[byteIndex], bitIndex) != bitRead(last_input_state[byteIndex], bitIndex)) {
-      String topic = String(MQTT_TOPIC_PREFIX_SENSOR) + String(NodeID) + "/sensor/S" + String(i);
-      String payload = (bitRead(currentInputState[byteIndex], bitIndex) == 0) ? "ACTIVE" : "INACTIVE";
-      client.publish(topic.c_str(), payload.c_str(), true);
+    // Sensors not yet covered by a pending snapshot are published by the snapshot instead
+    if (snapshotPending && arrayIndex >= snapshotNextIndex) {
+      continue;
+    }
+    byte state = bitRead(currentInputState[byteIndex], bitIndex);
+    if (state != bitRead(last_input_state[byteIndex], bitIndex)) {
+      // Out of tokens or the publish failed: keep the last published state so the change is retried next loop
+      if (publishTokens <= 0 || !publishSensor(i, state)) {
+        break;
+      }
+      publishTokens--;
+      bitWrite(last_input_state[byteIndex], bitIndex, state); // Remember the published state for the next comparison
     }
   }
 
-  // Update the last input state for the next comparison
-  memcpy(last_input_state, currentInputState, 9);
+  // Continue the retained snapshot of all inputs after a (re)connect
+  publishInputSnapshot(currentInputState);
 
   // Delay before next loop iteration
   delay(10);
@@ -115,6 +136,7 @@ void reconnect() {
     if (client.connect(NodeID)) {
       Serial.println("connected");
       // Subscribe to MQTT topics if required
+      startInputSnapshot(); // Publish a retained snapshot of all inputs
     } else {
       Serial.print("failed, rc=");
       Serial.print(client.state());
@@ -123,3 +145,58 @@ void reconnect() {
     }
   }
 }
+
+// Function to start publishing a retained snapshot of all inputs
+void startInputSnapshot() {
+  snapshotPending = true;
+  snapshotNextIndex = 0;
+  snapshotStartMillis = millis();
+}
+
+// Function to refill the publish token bucket based on elapsed time
+void refillPublishTokens() {
+  unsigned long now = millis();
+  unsigned long earned = (now - lastTokenRefill) / PUBLISH_TOKEN_INTERVAL;
+  if (earned > 0) {
+    publishTokens = min((long)PUBLISH_BUCKET_CAPACITY, (long)publishTokens + (long)earned);
+    lastTokenRefill += earned * PUBLISH_TOKEN_INTERVAL;
+  }
+}
+
+// Function to publish the retained state of a single sensor. Returns false if PubSubClient could not write the message.
+bool publishSensor(int sensorId, byte state) {
+  char topic[80];
+  snprintf(topic, sizeof(topic), "%s%s/sensor/S%d", MQTT_TOPIC_PREFIX_SENSOR, NodeID, sensorId);
+  return client.publish(topic, (state == 0) ? "ACTIVE" : "INACTIVE", true);
+}
+
+// Function to continue the pending snapshot as far as the token bucket allows
+void publishInputSnapshot(const byte* inputState) {
+  if (!snapshotPending) {
+    return;
+  }
+
+  while (snapshotNextIndex <= maxSensorId - minSensorId && publishTokens > 0) {
+    int byteIndex = snapshotNextIndex / 8;
+    int bitIndex = snapshotNextIndex % 8;
+    byte state = bitRead(inputState[byteIndex], bitIndex);
+    // If the publish failed, keep the token and retry this sensor on the next loop
+    if (!publishSensor(snapshotNextIndex + minSensorId, state)) {
+      return;
+    }
+    publishTokens--;
+    bitWrite(last_input_state[byteIndex], bitIndex, state); // Remember the published state for the next comparison
+    snapshotNextIndex++;
+  }
+
+  if (snapshotNextIndex > maxSensorId - minSensorId) {
+    snapshotPending = false;
+    Serial.print("Input snapshot published: ");
+    Serial.print(maxSensorId - minSensorId + 1);
+    Serial.print(" sensors in ");
+    Serial.print(millis() - snapshotStartMillis);
+    Serial.print(" ms (panel synced ");
+    Serial.print(millis());
+    Serial.println(" ms after boot)");
+  }
+}
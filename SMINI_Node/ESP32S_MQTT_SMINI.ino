@@ -1,8 +1,8 @@
 /*
   Project: ESP32S based WiFi CMRI/MQTT enabled SMINI Node (48 outputs / 24 inputs)
   Author: Thomas Seitz (thomas.seitz@tmrci.org)
-  Version: 1.0.2
-  Date: 2023-06-07
+  Version: 1.0.4
+  Date: 2026-10-18
   Description: A sketch for an ESP32S based CMRI SMINI Node (48 outputs / 24 inputs) 
   using MQTT to subscribe to and publish messages published by and subscribed to by JMRI.
   Published Sensor message payload is 'ACTIVE' / 'INACTIVE'. Expected incoming subscribed messages are
@@ -50,10 +50,48 @@ const int maxOutputId = 48;
 const int minSensorId = 1;
 const int maxSensorId = 24;
 
+// Output topic prefix ("TMRCI/output/<NodeID>/") and subscription filter, built once in setup()
+char outputTopicPrefix[64];
+size_t outputTopicPrefixLength = 0;
+char outputTopicFilter[66];
+
+// Lookup table mapping a JMRI device type and payload to the output bit state
+struct OutputCommand {
+  char deviceType;      // 'T' for Turnouts, 'L' for Lights
+  const char* payload;  // Expected message payload
+  byte payloadLength;   // Length of the payload, compared before the bytes
+  bool isOn;            // Output bit state for this payload
+};
+
+const OutputCommand outputCommands[] = {
+  {'T', "NORMAL",  6, false},
+  {'T', "REVERSE", 7, true},
+  {'L', "ON",      2, true},
+  {'L', "OFF",     3, false}
+};
+const int outputCommandCount = sizeof(outputCommands) / sizeof(outputCommands[0]);
+
+// Token bucket pacing MQTT publishes so a full snapshot does not overrun the
+// PubSubClient buffer or the WiFi TX queue
+const int PUBLISH_BUCKET_CAPACITY = 8;           // Maximum back-to-back publishes
+const unsigned long PUBLISH_TOKEN_INTERVAL = 5;  // Milliseconds to earn one publish token
+int publishTokens = PUBLISH_BUCKET_CAPACITY;
+unsigned long lastTokenRefill = 0;
+
+// Retained full-state snapshot published whenever MQTT (re)connects
+bool snapshotPending = false;             // True while the snapshot is in progress
+int snapshotNextIndex = 0;                // Next sensor (array index) to publish
+unsigned long snapshotStartMillis = 0;    // Time the snapshot was started
+
 // Function declarations for MQTT
 void callback(char* topic, byte* payload, unsigned int length);
 void reconnect();
+void subscribeOutputs();
 void updateOutputs();
+void startInputSnapshot();
+void refillPublishTokens();
+void publishInputSnapshot(const byte* inputState);
+bool publishSensor(int sensorId, byte state);
 
 void setup() {
   // Set up input and output shift registers
@@ -81,14 +119,18 @@ void setup() {
   Serial.println("IP address: ");
   Serial.println(WiFi.localIP());
 
+  // Build the output topic prefix and wildcard filter once
+  outputTopicPrefixLength = snprintf(outputTopicPrefix, sizeof(outputTopicPrefix), "%s%s/", MQTT_TOPIC_PREFIX_OUTPUT, NodeID);
+  snprintf(outputTopicFilter, sizeof(outputTopicFilter), "%s#", outputTopicPrefix);
+
   // Set up MQTT
   client.setServer(mqtt_server, 1883);
   client.setCallback(callback);
 
   if (client.connect(NodeID)) {
     Serial.println("connected");
-    String outputTopic = String(MQTT_TOPIC_PREFIX_OUTPUT) + String(NodeID) + "/";
-    client.subscribe(outputTopic.c_str());
+    subscribeOutputs();
+    startInputSnapshot(); // Publish a retained snapshot of all inputs
   }
 }
 void loop() {
@@ -132,19 +174,28 @@ void loop() {
   }
 
   // Publish input state changes over MQTT
+  refillPublishTokens();
   for (int i = minSensorId; i <= maxSensorId; i++) {
     int arrayIndex = i - minSensorId;
     int byteIndex = arrayIndex / 8;
     int bitIndex = arrayIndex % 8;
-    if (bitRead(currentInputState[byteIndex], bitIndex) != bitRead(last_input_state[byteIndex], bitIndex)) {
-      String topic = String(MQTT_TOPIC_PREFIX_SENSOR) + String(NodeID) + "/sensor/S" + String(i);
-      String payload = (bitRead(currentInputState[byteIndex], bitIndex) == 0) ? "ACTIVE" : "INACTIVE";
-      client.publish(topic.c_str(), payload.c_str(), true);
+    // Sensors not yet covered by a pending snapshot are published by the snapshot instead
+    if (snapshotPending && arrayIndex >= snapshotNextIndex) {
+      continue;
+    }
+    byte state = bitRead(currentInputState[byteIndex], bitIndex);
+    if (state != bitRead(last_input_state[byteIndex], bitIndex)) {
+      // Out of tokens or the publish failed: keep the last published state so the change is retried next loop
+      if (publishTokens <= 0 || !publishSensor(i, state)) {
+        break;
+      }
+      publishTokens--;
+      bitWrite(last_input_state[byteIndex], bitIndex, state); // Remember the published state for the next comparison
     }
   }
 
-  // Copy the current input state to the last input state for the next comparison
-  memcpy(last_input_state, currentInputState, 3);
+  // Continue the retained snapshot of all inputs after a (re)connect
+  publishInputSnapshot(currentInputState);
   
   // Add a delay before next loop
   delay(10);
@@ -157,8 +208,8 @@ void reconnect() {
     Serial.print("Attempting MQTT connection...");
     if (client.connect(NodeID)) {
       Serial.println("connected");
-      String outputTopic = String(MQTT_TOPIC_PREFIX_OUTPUT) + String(NodeID) + "/";
-      client.subscribe(outputTopic.c_str());
+      subscribeOutputs();
+      startInputSnapshot(); // Publish a retained snapshot of all inputs
     } else {
       Serial.print("failed, rc=");
       Serial.print(client.state());
@@ -168,26 +219,108 @@ void reconnect() {
   }
 }
 
+// Function to subscribe to all Turnout and Light topics of this node
+void subscribeOutputs() {
+  client.subscribe(outputTopicFilter);
+}
+
 void callback(char* topic, byte* payload, unsigned int length) {
-  // Ensure the message is for our topic
-  String receivedTopic = String(topic);
-  String deviceType = receivedTopic.substring(receivedTopic.lastIndexOf("/") + 1, receivedTopic.lastIndexOf("/") + 2);
-  String deviceIdStr = receivedTopic.substring(receivedTopic.lastIndexOf("/") + 2);
-  int deviceId = deviceIdStr.toInt();
-
-  // Only process messages within the defined device ID range
-  if (deviceId >= minOutputId && deviceId <= maxOutputId) {
-    char message[length + 1];
-    memcpy(message, payload, length);
-    message[length] = '\0';
-    String receivedMessage = String(message);
-
-    int arrayIndex = deviceId - minOutputId;
-    int byteIndex = arrayIndex / 8;
-    int bitIndex = arrayIndex % 8;
-    bool isOn = ((deviceType == "T" && receivedMessage == "REVERSE") || (deviceType == "L" && receivedMessage == "ON"));
-    bitWrite(last_output_state[byteIndex], bitIndex, isOn ? 1 : 0);
-    updateOutputs();
+  // Ensure the message is for our node
+  if (strncmp(topic, outputTopicPrefix, outputTopicPrefixLength) != 0) {
+    return;
+  }
+
+  // The device name ("T<n>" / "L<n>") is the last level of the topic
+  const char* deviceName = strrchr(topic + outputTopicPrefixLength, '/');
+  deviceName = (deviceName != NULL) ? deviceName + 1 : topic + outputTopicPrefixLength;
+
+  // Decode the device ID, rejecting anything that is not all digits or out of range
+  char deviceType = deviceName[0];
+  const char* digit = deviceName + 1;
+  int deviceId = 0;
+  if (deviceType == '\0' || *digit == '\0') {
+    return;
+  }
+  for (; *digit != '\0'; digit++) {
+    if (*digit < '0' || *digit > '9') {
+      return;
+    }
+    deviceId = deviceId * 10 + (*digit - '0');
+    if (deviceId > maxOutputId) {
+      return;
+    }
+  }
+  if (deviceId < minOutputId) {
+    return;
+  }
+
+  // Find the matching device type and payload in the lookup table
+  for (int i = 0; i < outputCommandCount; i++) {
+    const OutputCommand& command = outputCommands[i];
+    if (command.deviceType == deviceType && command.payloadLength == length &&
+        memcmp(command.payload, payload, length) == 0) {
+      int arrayIndex = deviceId - minOutputId;
+      int byteIndex = arrayIndex / 8;
+      int bitIndex = arrayIndex % 8;
+      bitWrite(last_output_state[byteIndex], bitIndex, command.isOn ? 1 : 0);
+      updateOutputs();
+      return;
+    }
+  }
+}
+
+// Function to start publishing a retained snapshot of all inputs
+void startInputSnapshot() {
+  snapshotPending = true;
+  snapshotNextIndex = 0;
+  snapshotStartMillis = millis();
+}
+
+// Function to refill the publish token bucket based on elapsed time
+void refillPublishTokens() {
+  unsigned long now = millis();
+  unsigned long earned = (now - lastTokenRefill) / PUBLISH_TOKEN_INTERVAL;
+  if (earned > 0) {
+    publishTokens = min((long)PUBLISH_BUCKET_CAPACITY, (long)publishTokens + (long)earned);
+    lastTokenRefill += earned * PUBLISH_TOKEN_INTERVAL;
+  }
+}
+
+// Function to publish the retained state of a single sensor. Returns false if PubSubClient could not write the message.
+bool publishSensor(int sensorId, byte state) {
+  char topic[80];
+  snprintf(topic, sizeof(topic), "%s%s/sensor/S%d", MQTT_TOPIC_PREFIX_SENSOR, NodeID, sensorId);
+  return client.publish(topic, (state == 0) ? "ACTIVE" : "INACTIVE", true);
+}
+
+// Function to continue the pending snapshot as far as the token bucket allows
+void publishInputSnapshot(const byte* inputState) {
+  if (!snapshotPending) {
+    return;
+  }
+
+  while (snapshotNextIndex <= maxSensorId - minSensorId && publishTokens > 0) {
+    int byteIndex = snapshotNextIndex / 8;
+    int bitIndex = snapshotNextIndex % 8;
+    byte state = bitRead(inputState[byteIndex], bitIndex);
+    // If the publish failed, keep the token and retry this sensor on the next loop
+    if (!publishSensor(snapshotNextIndex + minSensorId, state)) {
+      return;
+    }
+    publishTokens--;
+    bitWrite(last_input_state[byteIndex], bitIndex, state); // Remember the published state for the next comparison
+    snapshotNextIndex++;
+  }
+
+  if (snapshotNextIndex > maxSensorId - minSensorId) {
+    snapshotPending = false;
+    Serial.print("Input snapshot published: ");
+    Serial.print(maxSensorId - minSensorId + 1);
+    Serial.print(" sensors in ");
+    Serial.print(millis() - snapshotStartMillis);
+    Serial.print(" ms (panel synced ");
+    Serial.print(millis());
+    Serial.println(" ms after boot)");
   }
 }
 
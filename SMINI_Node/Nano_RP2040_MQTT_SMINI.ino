@@ -1,8 +1,8 @@
 /*
   Project: Arduino-Nano RP2040 based WiFi CMRI/MQTT enabled SMINI Node (48 outputs / 24 inputs)
   Author: Thomas Seitz (thomas.seitz@tmrci.org)
-  Version: 1.1.1
-  Date: 2023-05-28
+  Version: 1.1.2
+  Date: 2026-10-18
   Description: A sketch for an Arduino-Nano RP2040 based CMRI SMINI Node (48 outputs / 24 inputs) 
   using MQTT to subscribe to and publish messages published by and subscribed to by JMRI.
   Published Sensor message payload is 'ACTIVE' / 'INACTIVE'. Expected incoming subscribed messages are
@@ -49,10 +49,26 @@ const int maxOutputId = 48;
 const int minSensorId = 1;
 const int maxSensorId = 24;
 
+// Token bucket pacing MQTT publishes so a full snapshot does not overrun the
+// PubSubClient buffer or the WiFi TX queue
+const int PUBLISH_BUCKET_CAPACITY = 8;           // Maximum back-to-back publishes
+const unsigned long PUBLISH_TOKEN_INTERVAL = 5;  // Milliseconds to earn one publish token
+int publishTokens = PUBLISH_BUCKET_CAPACITY;
+unsigned long lastTokenRefill = 0;
+
+// Retained full-state snapshot published whenever MQTT (re)connects
+bool snapshotPending = false;             // True while the snapshot is in progress
+int snapshotNextIndex = 0;                // Next sensor (array index) to publish
+unsigned long snapshotStartMillis = 0;    // Time the snapshot was started
+
 // Function declarations for MQTT
 void callback(char* topic, byte* payload, unsigned int length);
 void reconnect();
 void updateOutputs();
+void startInputSnapshot();
+void refillPublishTokens();
+void publishInputSnapshot(const byte* inputState);
+bool publishSensor(int sensorId, byte state);
 
 void setup() {
   // Set up input and output shift registers
@@ -88,6 +104,7 @@ void setup() {
     Serial.println("connected");
     String outputTopic = String(MQTT_TOPIC_PREFIX_OUTPUT) + String(NodeID) + "/";
     client.subscribe(outputTopic.c_str());
+    startInputSnapshot(); // Publish a retained snapshot of all inputs
   }
 }
 
@@ -132,19 +149,28 @@ void loop() {
   }
 
   // Publish input state changes over MQTT
+  refillPublishTokens();
   for (int i = minSensorId; i <= maxSensorId; i++) {
     int arrayIndex = i - minSensorId;
     int byteIndex = arrayIndex / 8;
     int bitIndex = arrayIndex % 8;
-    if (bitRead(currentInputState[byteIndex], bitIndex) != bitRead(last_input_state[byteIndex], bitIndex)) {
-      String topic = String(MQTT_TOPIC_PREFIX_SENSOR) + String(NodeID) + "/sensor/S" + String(i);
-      String payload = (bitRead(currentInputState[byteIndex], bitIndex) == 0) ? "ACTIVE" : "INACTIVE";
-      client.publish(topic.c_str(), payload.c_str(), true);
+    // Sensors not yet covered by a pending snapshot are published by the snapshot instead
+    if (snapshotPending && arrayIndex >= snapshotNextIndex) {
+      continue;
+    }
+    byte state = bitRead(currentInputState[byteIndex], bitIndex);
+    if (state != bitRead(last_input_state[byteIndex], bitIndex)) {
+      // Out of tokens or the publish failed: keep the last published state so the change is retried next loop
+      if (publishTokens <= 0 || !publishSensor(i, state)) {
+        break;
+      }
+      publishTokens--;
+      bitWrite(last_input_state[byteIndex], bitIndex, state); // Remember the published state for the next comparison
     }
   }
 
-  // Copy the current input state to the last input state for the next comparison
-  memcpy(last_input_state, currentInputState, 3);
+  // Continue the retained snapshot of all inputs after a (re)connect
+  publishInputSnapshot(currentInputState);
   
   // Add a delay before next loop
   delay(10);
@@ -159,6 +185,7 @@ void reconnect() {
       Serial.println("connected");
       String outputTopic = String(MQTT_TOPIC_PREFIX_OUTPUT) + String(NodeID) + "/";
       client.subscribe(outputTopic.c_str());
+      startInputSnapshot(); // Publish a retained snapshot of all inputs
     } else {
       Serial.print("failed, rc=");
       Serial.print(client.state());
@@ -191,6 +218,61 @@ void callback(char* topic, byte* payload, unsigned int length) {
   }
 }
 
+// Function to start publishing a retained snapshot of all inputs
+void startInputSnapshot() {
+  snapshotPending = true;
+  snapshotNextIndex = 0;
+  snapshotStartMillis = millis();
+}
+
+// Function to refill the publish token bucket based on elapsed time
+void refillPublishTokens() {
+  unsigned long now = millis();
+  unsigned long earned = (now - lastTokenRefill) / PUBLISH_TOKEN_INTERVAL;
+  if (earned > 0) {
+    publishTokens = min((long)PUBLISH_BUCKET_CAPACITY, (long)publishTokens + (long)earned);
+    lastTokenRefill += earned * PUBLISH_TOKEN_INTERVAL;
+  }
+}
+
+// Function to publish the retained state of a single sensor. Returns false if PubSubClient could not write the message.
+bool publishSensor(int sensorId, byte state) {
+  char topic[80];
+  snprintf(topic, sizeof(topic), "%s%s/sensor/S%d", MQTT_TOPIC_PREFIX_SENSOR, NodeID, sensorId);
+  return client.publish(topic, (state == 0) ? "ACTIVE" : "INACTIVE", true);
+}
+
+// Function to continue the pending snapshot as far as the token bucket allows
+void publishInputSnapshot(const byte* inputState) {
+  if (!snapshotPending) {
+    return;
+  }
+
+  while (snapshotNextIndex <= maxSensorId - minSensorId && publishTokens > 0) {
+    int byteIndex = snapshotNextIndex / 8;
+    int bitIndex = snapshotNextIndex % 8;
+    byte state = bitRead(inputState[byteIndex], bitIndex);
+    // If the publish failed, keep the token and retry this sensor on the next loop
+    if (!publishSensor(snapshotNextIndex + minSensorId, state)) {
+      return;
+    }
+    publishTokens--;
+    bitWrite(last_input_state[byteIndex], bitIndex, state); // Remember the published state for the next comparison
+    snapshotNextIndex++;
+  }
+
+  if (snapshotNextIndex > maxSensorId - minSensorId) {
+    snapshotPending = false;
+    Serial.print("Input snapshot published: ");
+    Serial.print(maxSensorId - minSensorId + 1);
+    Serial.print(" sensors in ");
+    Serial.print(millis() - snapshotStartMillis);
+    Serial.print(" ms (panel synced ");
+    Serial.print(millis());
+    Serial.println(" ms after boot)");
+  }
+}
+
 // Function to update the outputs
 void updateOutputs() {
   digitalWrite(LATCH_595, LOW);